@@ -135,9 +135,12 @@
 // 06-07-2021, ES: Switched to LittleFS.
 // 06-07-2021, ES: Added SPI RAM (experimental).
 // 08-02-2022, ES: Added redirection.
+// 18-10-2026: Deferred TFT update in small slices between VS1053 feeds, scroll long lines.
+// 18-10-2026: Staged upload to LittleFS, resume and CRC check.
+// 18-10-2026: Automatic clock drift compensation with AdjustRate.
 //
 // Define the version number, also used for webserver as Last-Modified header:
-#define VERSION "Fri, 11 Feb 2022 13:05:00 GMT"
+#define VERSION "Sun, 18 Oct 2026 18:00:00 GMT"
 // Experimental SPI-RAM
 //#define SPIRAM                                 // Use SPIRAM as ringbuffer. Undefined = do not use
 //#define SPIRAMDELAY 100000                     // Delay (in bytes) before reading from SPIRAM
@@ -163,6 +166,9 @@
 #ifdef SPIRAM
   #include "spiram.hpp"
 #endif
+#include "tftlayout.hpp"
+#include "upload.hpp"
+#include "drift.hpp"
 extern "C"
 {
   #include "user_interface.h"
@@ -189,6 +195,11 @@ extern "C"
 #define CYAN    GREEN | BLUE
 #define MAGENTA RED | BLUE
 #define YELLOW  RED | GREEN
+// Layout of the text on the TFT screen (if used).  The default font is 6 x 8 pixels.
+#define TFTROWS   15                           // Total number of text rows in all segments
+#define TFTSECS   3                            // Number of screen segments, see tftdata[]
+#define TFTSLICE  2000                         // Max. time for one TFT update slice in usec
+#define TFTSCROLL 300                          // Time between 2 scroll steps in msec
 // Digital I/O used
 // Pins for VS1053 module
 #define VS1053_CS     5
@@ -204,8 +215,12 @@ extern "C"
 // Ringbuffer for smooth playing. 20000 bytes is 160 Kbits, about 1.5 seconds at 128kb bitrate.
 // If buffer is too long, the webinterface does not work anymore
 #define RINGBFSIZ 18000
+// Uploaded files are staged in a buffer and written to LittleFS in pages (see upload.cpp).
+// In loop() this is only done if the ringbuffer is filled for at least UPMINFILL percent.
+#define UPMINFILL   50                         // Minimal ringbuffer filling in percent
+#define UPTIMEOUT 15000                        // Upload abandoned if no data for this time (msec)
 // Debug buffer size
-#define DEBUG_BUFFER_SIZE 100
+#define DEBUG_BUFFER_SIZE 150
 // Name of the ini file
 #define INIFILENAME "/radio.ini"
 // Access point name if connection to WiFi network fails.  Also the hostname for WiFi and OTA.
@@ -218,8 +233,9 @@ extern "C"
 //******************************************************************************************
 // Forward declaration of various functions                                                *
 //******************************************************************************************
-//void   displayinfo ( const char* str, uint16_t pos, uint16_t height, uint16_t color ) ;
+//void   displayinfo ( const char* str, uint8_t inx, uint16_t color ) ;
 void   showstreamtitle ( const char* ml, bool full = false ) ;
+void   tftclear ( bool reset ) ;
 void   handlebyte ( uint8_t b, bool force = false ) ;
 void   handlebyte_ch ( uint8_t b, bool force = false ) ;
 void   handleFS ( AsyncWebServerRequest* request ) ;
@@ -227,6 +243,8 @@ void   handleFSf ( AsyncWebServerRequest* request, const String& filename ) ;
 void   handleCmd ( AsyncWebServerRequest* request )  ;
 void   handleFileUpload ( AsyncWebServerRequest* request, String filename,
                           size_t index, uint8_t* data, size_t len, bool final ) ;
+void   handle_upload() ;
+void   handle_rate() ;
 char*  dbgprint( const char* format, ... ) ;
 char*  analyzeCmd ( const char* str ) ;
 char*  analyzeCmd ( const char* par, const char* val ) ;
@@ -279,6 +297,12 @@ IPAddress        mqtt_server_IP ;                          // IP address of MQTT
 char             cmd[130] ;                                // Command from MQTT or Serial
 #if defined ( USETFT )
 TFT_ILI9163C     tft = TFT_ILI9163C ( TFT_CS, TFT_DC ) ;
+scrseg_struct    tftdata[TFTSECS] =                        // Screen segments: y, rows, row0
+                 { {  0, 2, 0 },                           // Top line
+                   { 20, 5, 2 },                           // Artist and title
+                   { 60, 8, 7 }                            // Station name or other info
+                 } ;
+char             tftshown[TFTROWS][TFTCOLS] ;              // Characters currently on the screen
 #endif
 Ticker           tckr ;                                    // For timing 100 msec
 TinyXML          xml;                                      // For XML parser.
@@ -322,6 +346,10 @@ uint8_t          prcrinx ;                                 // Index in prchunk (
 #ifdef SPIRAM
   int32_t        spiramdelay = SPIRAMDELAY ;               // Delay before reading from SPIRAM
 #endif
+uint32_t         underruns = 0 ;                           // Number of times the ringbuffer ran dry
+uint32_t         uptime ;                                  // Time of latest upload fragment
+bool             ratectl = true ;                          // Automatic clock drift compensation
+uint8_t          ratewait = RATEWAIT ;                     // Intervals to skip before control
 // XML parse globals.
 const char* xmlhost = "playerservices.streamtheworld.com" ;// XML data source
 const char* xmlget =  "GET /api/livestream"                // XML get parameters
@@ -773,6 +801,33 @@ inline uint16_t ringavail()
 }
 
 
+//******************************************************************************************
+//                              R I N G L E V E L                                          *
+//******************************************************************************************
+// Return the filling of the ringbuffer in per mille for a count as given by ringavail().  *
+//******************************************************************************************
+inline uint16_t ringlevel ( uint16_t avl )
+{
+  #ifdef SPIRAM
+    return avl * 1000UL /               // Chunks filled related to total number of chunks
+           ( dataAvailable() + getFreeBufferSpace() ) ;
+  #else
+    return avl * 1000UL / RINGBFSIZ ;   // Bytes filled related to size
+  #endif
+}
+
+
+//******************************************************************************************
+//                               R I N G F I L L                                           *
+//******************************************************************************************
+// Return the filling of the ringbuffer in percent.                                        *
+//******************************************************************************************
+inline uint8_t ringfill()
+{
+  return ringlevel ( ringavail() ) / 10 ;
+}
+
+
 //******************************************************************************************
 //                                P U T R I N G                                            *
 //******************************************************************************************
@@ -1242,12 +1297,13 @@ void timer100()
 void displayvolume()
 {
 #if defined ( USETFT )
-  static uint8_t oldvol = 0 ;                        // Previous volume
+  static uint8_t oldvol = 255 ;                      // Previous volume, force first update
   uint8_t pos ;                                      // Positon of volume indicator
 
   if ( vs1053player.getVolume() != oldvol )
   {
-    pos = map ( vs1053player.getVolume(), 0, 100, 0, 160 ) ;
+    oldvol = vs1053player.getVolume() ;              // Remember for change detection
+    pos = map ( oldvol, 0, 100, 0, 160 ) ;
     tft.fillRect ( 0, 126, pos, 2, RED ) ;             // Paint red part
     tft.fillRect ( pos, 126, 160 - pos, 2, GREEN ) ;   // Paint green part
   }
@@ -1258,25 +1314,119 @@ void displayvolume()
 //******************************************************************************************
 //                              D I S P L A Y I N F O                                      *
 //******************************************************************************************
-// Show a string on the LCD at a specified y-position in a specified color                 *
+// Set the text for a screen segment in a specified color.  The screen itself will be      *
+// updated later on by handle_tft().                                                       *
 //******************************************************************************************
 #if defined ( USETFT )
-void displayinfo ( const char* str, uint16_t pos, uint16_t height, uint16_t color )
+void displayinfo ( const char* str, uint8_t inx, uint16_t color )
 {
   char buf [ strlen ( str ) + 1 ] ;             // Need some buffer space
-  
+
   strcpy ( buf, str ) ;                         // Make a local copy of the string
   utf8ascii ( buf ) ;                           // Convert possible UTF8
-  tft.fillRect ( 0, pos, 160, height, BLACK ) ; // Clear the space for new info
-  tft.setTextColor ( color ) ;                  // Set the requested color
-  tft.setCursor ( 0, pos ) ;                    // Prepare to show the info
-  tft.println ( buf ) ;                         // Show the string
+  tftsettext ( &tftdata[inx], tftshown[tftdata[inx].row0], buf, color ) ;
 }
 #else
-#define displayinfo(a,b,c,d)                    // Empty declaration
+#define displayinfo(a,b,c)                      // Empty declaration
+#endif
+
+
+//******************************************************************************************
+//                              T F T S T O P                                              *
+//******************************************************************************************
+// Check if drawing on the TFT must stop: the VS1053 asks for data that is available in    *
+// the ringbuffer or the slice takes too long.  Used as callback for tftrender().          *
+//******************************************************************************************
+#if defined ( USETFT )
+uint32_t tftt0 ;                                // Start of this TFT slice
+
+bool tftstop()
+{
+  return ( vs1053player.data_request() && ringavail() ) ||
+         ( ( micros() - tftt0 ) > TFTSLICE ) ;
+}
+
+
+//******************************************************************************************
+//                              T F T D R A W                                              *
+//******************************************************************************************
+// Draw one character on the TFT.  Used as callback for tftrender().                       *
+//******************************************************************************************
+void tftdraw ( int16_t x, int16_t y, char c, uint16_t color )
+{
+  tft.drawChar ( x, y, c, color, BLACK, 1 ) ;   // Draw with background
+}
 #endif
 
 
+//******************************************************************************************
+//                              H A N D L E _ T F T                                        *
+//******************************************************************************************
+// Bring the screen in line with the requested contents in tftdata.  Only the characters   *
+// that differ from tftshown are drawn.  The work is done in small slices: it stops if the *
+// VS1053 asks for data that is available in the ringbuffer or if the slice takes too long.*
+// The next call will continue where this call has stopped.                                *
+//******************************************************************************************
+void handle_tft()
+{
+#if defined ( USETFT )
+  static uint8_t  inx = 0 ;                     // Segment to handle
+  static uint32_t scrolltime = 0 ;              // Time of latest scroll step
+  uint8_t         n ;                           // Loop control
+
+  tftt0 = micros() ;                            // Start of this slice
+  if ( ( millis() - scrolltime ) >= TFTSCROLL ) // Time for next scroll step?
+  {
+    scrolltime = millis() ;
+    for ( n = 0 ; n < TFTSECS ; n++ )
+    {
+      tftscroll ( &tftdata[n] ) ;               // Scroll long lines one position
+    }
+  }
+  displayvolume() ;                             // Show volume on display
+  for ( n = 0 ; n < TFTSECS ; n++ )             // Search for work in all segments
+  {
+    if ( !tftrender ( &tftdata[inx], tftshown[tftdata[inx].row0],
+                      tftstop, tftdraw ) )      // Bring segment up-to-date
+    {
+      return ;                                  // Out of time, continue later
+    }
+    inx = ( inx + 1 ) % TFTSECS ;               // Try next segment
+  }
+#endif
+}
+
+
+//******************************************************************************************
+//                              T F T C L E A R                                            *
+//******************************************************************************************
+// Request clearing of all text on the screen.  If reset is true, the screen is cleared at *
+// once (including the bands between the segments) and the requested contents of the      *
+// segments will be drawn again.  Use that only in setup().                                *
+//******************************************************************************************
+void tftclear ( bool reset )
+{
+#if defined ( USETFT )
+  int i ;                                       // Loop control
+
+  if ( reset )
+  {
+    tft.fillRect ( 0, 0, 160, 128, BLACK ) ;    // Clear screen now
+    memset ( tftshown, ' ', sizeof(tftshown) ) ;
+  }
+  for ( i = 0 ; i < TFTSECS ; i++ )
+  {
+    if ( !reset )
+    {
+      displayinfo ( "", i, BLACK ) ;            // Empty segment
+    }
+    tftdata[i].nextrow = 0 ;                    // Check all rows
+    tftdata[i].update_req = true ;
+  }
+#endif
+}
+
+
 //******************************************************************************************
 //                        S H O W S T R E A M T I T L E                                    *
 //******************************************************************************************
@@ -1330,7 +1480,7 @@ void showstreamtitle ( const char *ml, bool full )
     }
     strcpy ( p1, p2 ) ;                         // Shift 2nd part of title 2 or 3 places
   }
-  displayinfo ( streamtitle, 20, 40, CYAN ) ;   // Show title at position 20
+  displayinfo ( streamtitle, 1, CYAN ) ;        // Show title in segment 1
 }
 
 
@@ -1371,7 +1521,7 @@ bool connecttohost()
 
   stop_mp3client() ;                                // Disconnect if still connected
   dbgprint ( "Connect to new host %s", host.c_str() ) ;
-  displayinfo ( "   ** Internet radio **", 0, 20, WHITE ) ;
+  displayinfo ( "   ** Internet radio **", 0, WHITE ) ;
   datamode = INIT ;                                 // Start default in metamode
   chunked = false ;                                 // Assume not chunked
   if ( host.endsWith ( ".m3u" ) )                   // Is it an m3u playlist?
@@ -1400,7 +1550,7 @@ bool connecttohost()
   }
   pfs = dbgprint ( "Connect to %s on port %d, extension %s",
                    hostwoext.c_str(), port, extension.c_str() ) ;
-  displayinfo ( pfs, 60, 66, YELLOW ) ;             // Show info at position 60..125
+  displayinfo ( pfs, 2, YELLOW ) ;                  // Show info in segment 2
   mp3client = new WiFiClient() ;
   if ( mp3client->connect ( hostwoext.c_str(), port ) )
   {
@@ -1431,7 +1581,7 @@ bool connecttofile()
   String path ;                                           // Full file spec
   char*  p ;                                              // Pointer to filename
 
-  displayinfo ( "   **** MP3 Player ****", 0, 20, WHITE ) ;
+  displayinfo ( "   **** MP3 Player ****", 0, WHITE ) ;
   path = host.substring ( 9 ) ;                           // Path, skip the "localhost" part
   mp3file = LittleFS.open ( path, "r" ) ;                 // Open the file
   if ( !mp3file )
@@ -1442,7 +1592,7 @@ bool connecttofile()
   p = (char*)path.c_str() + 1 ;                           // Point to filename
   showstreamtitle ( p, true ) ;                           // Show the filename as title
   displayinfo ( "Playing from local file",
-                60, 68, YELLOW ) ;                        // Show Source at position 60
+                2, YELLOW ) ;                             // Show Source in segment 2
   icyname = "" ;                                          // No icy name yet
   chunked = false ;                                       // File not chunked
   return true ;
@@ -1477,6 +1627,7 @@ bool connectwifi()
 #if defined ( USETFT )
   tft.println ( pfs ) ;
 #endif
+  displayinfo ( pfs, 1, WHITE ) ;                      // Keep in title area until a title arrives
   return true ;
 }
 
@@ -1962,6 +2113,7 @@ void setup()
     currentpreset = ini_block.newpreset ;              // No network: do not start radio
   }
   delay ( 1000 ) ;                                     // Show IP for a while
+  tftclear ( true ) ;                                  // Clear screen, IP stays in title area
   analogrest = ( analogRead ( A0 ) + asw1 ) / 2  ;     // Assumed inactive analog input
   #ifdef SPIRAM
     dbgprint ( "Testing SPIRAM getring/putring" ) ;
@@ -2153,6 +2305,7 @@ void loop()
 {
   uint32_t    maxfilechunk  ;                           // Max number of bytes to read from
                                                         // stream or file
+  static bool underrun = false ;                        // Ringbuffer ran dry
 
   // Try to keep the ringbuffer filled up by adding as much bytes as possible
   if ( datamode & ( INIT | HEADER | DATA |              // Test op playing
@@ -2199,6 +2352,19 @@ void loop()
     #endif
     handlebyte_ch ( getring() ) ;                      // Yes, handle it
   }
+  if ( ( datamode == DATA ) && vs1053player.data_request() &&
+       ( ringavail() == 0 ) )                          // Ringbuffer ran dry?
+  {
+    if ( !underrun )                                   // Yes, new event?
+    {
+      underrun = true ;                                // Yes, count it
+      underruns++ ;
+    }
+  }
+  else if ( ringavail() )
+  {
+    underrun = false ;                                 // Data available again
+  }
   yield() ;
   if ( datamode == STOPREQD )                          // STOP requested?
   {
@@ -2216,9 +2382,7 @@ void loop()
     vs1053player.stopSong() ;                          // Stop playing
     emptyring() ;                                      // Empty the ringbuffer
     datamode = STOPPED ;                               // Yes, state becomes STOPPED
-#if defined ( USETFT )
-    tft.fillRect ( 0, 0, 160, 128, BLACK ) ;           // Clear screen does not work when rotated
-#endif
+    tftclear ( false ) ;                               // Clear screen (deferred)
     delay ( 500 ) ;
   }
   if ( localfile )
@@ -2312,7 +2476,9 @@ void loop()
   {
     vs1053player.setVolume ( ini_block.reqvol ) ;       // Unmute
   }
-  displayvolume() ;                                     // Show volume on display
+  handle_tft() ;                                        // Update display if time allows
+  handle_upload() ;                                     // Write next part of upload if any
+  handle_rate() ;                                       // Clock drift compensation
   if ( testfilename.length() )                          // File to test?
   {
     testfile ( testfilename ) ;                         // Yes, do the test
@@ -2526,8 +2692,8 @@ void handlebyte ( uint8_t b, bool force )
         {
           icyname = metaline.substring(9) ;            // Get station name
           icyname.trim() ;                             // Remove leading and trailing spaces
-          displayinfo ( icyname.c_str(), 60, 68,
-                        YELLOW ) ;                     // Show station name at position 60
+          displayinfo ( icyname.c_str(), 2,
+                        YELLOW ) ;                     // Show station name in segment 2
         }
         else if ( lcml.startsWith ( "transfer-encoding:" ) )
         {
@@ -2728,50 +2894,171 @@ String getContentType ( String filename )
 }
 
 
+//******************************************************************************************
+//                              H A N D L E _ U P L O A D                                  *
+//******************************************************************************************
+// Called from loop().  Write at most one page of a running upload to LittleFS.  While     *
+// playing, this is only done if the ringbuffer is filled well enough to bridge the time   *
+// of the flash write.  An upload without data for UPTIMEOUT msec is abandoned: the staged *
+// data is written and a checkpoint is saved, so the upload can be resumed later.          *
+//******************************************************************************************
+void handle_upload()
+{
+  if ( upbuf == NULL )                                // Upload active?
+  {
+    return ;                                          // No, nothing to do
+  }
+  if ( ( millis() - uptime ) > UPTIMEOUT )            // Client gone?
+  {
+    uploadsave() ;                                    // Yes, save what we have
+    dbgprint ( "File upload %s abandoned at %d bytes", uppath.c_str(), upout ) ;
+    upabort ( "timeout" ) ;
+    return ;
+  }
+  if ( ( datamode & ( DATA | METADATA ) ) &&          // Playing and ringbuffer low?
+       ( ringfill() < UPMINFILL ) )
+  {
+    return ;                                          // Yes, try again later
+  }
+  writeuppage ( false ) ;                             // Write one page
+}
+
+
+//******************************************************************************************
+//                                H A N D L E _ R A T E                                    *
+//******************************************************************************************
+// Called from loop().  Keep track of the lowest filling of the ringbuffer and adjust the  *
+// playback rate of the VS1053 once per RATEINT msec.  Only for streams, local files will  *
+// fill the ringbuffer without any delay.  Intervals with an underrun are skipped, these   *
+// are caused by the network, not by the clocks.                                           *
+//******************************************************************************************
+void handle_rate()
+{
+  static uint32_t t0 = 0 ;                            // Start of interval
+  static uint16_t minavl = 0xFFFF ;                   // Lowest ringavail() in interval
+  static uint32_t underruns0 = 0 ;                    // Underruns at start of interval
+  int32_t         newppm2 ;                           // New correction
+
+  if ( !ratectl )                                     // Automatic control?
+  {
+    return ;                                          // No, leave it to the user
+  }
+  if ( localfile || !( datamode & ( DATA | METADATA ) ) )
+  {
+    if ( rateppm2 )                                   // Not playing a stream, reset
+    {
+      rateppm2 = 0 ;
+      vs1053player.AdjustRate ( 0 ) ;
+    }
+    ratewait = RATEWAIT ;                             // Skip first part of next stream
+    return ;
+  }
+  if ( ringavail() < minavl )                         // Track lowest filling
+  {
+    minavl = ringavail() ;
+  }
+  if ( ( millis() - t0 ) < RATEINT )                  // End of interval?
+  {
+    return ;                                          // No, wait
+  }
+  t0 = millis() ;
+  if ( ratewait )                                     // Start of stream or control?
+  {
+    if ( --ratewait == 0 )                            // Yes, end of waiting time?
+    {
+      ratestart ( ringlevel ( minavl ) ) ;            // Yes, start controller
+    }
+  }
+  else if ( underruns == underruns0 )                 // No underrun in this interval?
+  {
+    newppm2 = ratestep ( ringlevel ( minavl ) ) ;     // Compute new correction
+    if ( newppm2 != rateppm2 )                        // Change?
+    {
+      rateppm2 = newppm2 ;                            // Yes, set it
+      vs1053player.AdjustRate ( rateppm2 ) ;
+    }
+  }
+  underruns0 = underruns ;                            // Start new interval
+  minavl = 0xFFFF ;
+}
+
+
 //******************************************************************************************
 //                         H A N D L E F I L E U P L O A D                                 *
 //******************************************************************************************
-// Handling of upload request.  Write file to SPIFFS.                                      *
+// Handling of upload request.  Write file to LittleFS.                                    *
+// The data is staged in upbuf and written in pages by handle_upload().  Only if upbuf is  *
+// full, a page is written here.                                                           *
+// Optional parameters in the URL:                                                         *
+//   offset = <number>    // Resume abandoned upload, data is appended to the file         *
+//   crc    = <hex>       // Expected CRC32 of the complete file                           *
+// Example: "/upload?offset=65536&crc=1A2B3C4D" with the rest of the file as contents.     *
 //******************************************************************************************
 void handleFileUpload ( AsyncWebServerRequest *request, String filename,
                         size_t index, uint8_t *data, size_t len, bool final )
 {
-  String          path ;                              // Filename including "/"
-  static File     f ;                                 // File handle output file
-  char*           reply ;                             // Reply for webserver
-  static uint32_t t ;                                 // Timer for progress messages
-  uint32_t        t1 ;                                // For compare
-  static uint32_t totallength ;                       // Total file length
-  static size_t   lastindex ;                         // To test same index
+  String             s ;                              // Value of offset parameter
+  char*              reply ;                          // Reply for webserver
+  static uint32_t    t ;                              // Start time of upload
+  static uint32_t    offset ;                         // File length at start (resume)
+  static uint32_t    underruns0 ;                     // Underruns at start of upload
+  uint32_t           crc ;                            // Expected CRC32
+  bool               good = true ;                    // Result of CRC check
 
   if ( index == 0 )
   {
-    path = String ( "/" ) + filename ;                // Form SPIFFS filename
-    LittleFS.remove ( path ) ;                        // Remove old file
-    f = LittleFS.open ( path, "w" ) ;                 // Create new file
+    offset = 0 ;                                      // Assume new file
+    if ( request->hasParam ( "offset" ) )             // Resume requested?
+    {
+      s = request->getParam ( "offset" )->value() ;
+      offset = s.toInt() ;
+    }
+    if ( request->hasParam ( "offset" ) &&            // Offset must be a number
+         ( ( s.length() == 0 ) || ( s.length() > 9 ) ||
+           ( strspn ( s.c_str(), "0123456789" ) != s.length() ) ) )
+    {
+      upabort ( "illegal offset" ) ;                  // Not a number, refuse the upload
+    }
+    else
+    {
+      uploadstart ( String ( "/" ) + filename, offset ) ;
+    }
+    underruns0 = underruns ;                          // For report
     t = millis() ;                                    // Start time
-    totallength = 0 ;                                 // Total file lengt still zero
-    lastindex = 0 ;                                   // Prepare test
+    uptime = t ;                                      // For timeout
+    dbgprint ( "File upload %s started at offset %d", filename.c_str(), offset ) ;
   }
-  t1 = millis() ;                                     // Current timestamp
-  // Yes, print progress
-  dbgprint ( "File upload %s, t = %d msec, len %d, index %d",
-               filename.c_str(), t1 - t, len, index ) ;
-  if ( len )                                          // Something to write?
+  if ( upbuf && len )                                 // Something to stage?
   {
-    if ( ( index != lastindex ) || ( index == 0 ) )   // New chunk?
-    {
-      f.write ( data, len ) ;                         // Yes, transfer to SPIFFS
-      totallength += len ;                            // Update stored length
-      lastindex = index ;                             // Remenber this part
-    }
+    uptime = millis() ;                               // Upload is still alive
+    uploadstage ( offset + index, data, len ) ;       // Stage the data
   }
   if ( final )                                        // Was this last chunk?
   {
-    f.close() ;                                       // Yes, clode the file
-    reply = dbgprint ( "File upload %s, %d bytes finished",
-                       filename.c_str(), totallength ) ;
-    request->send ( 200, "", reply ) ;
+    if ( upbuf )
+    {
+      while ( writeuppage ( true ) ) ;                // Write the rest
+    }
+    if ( upbuf == NULL )                              // Upload failed?
+    {
+      reply = dbgprint ( "File upload %s failed, %s",
+                         filename.c_str(), uperror ) ;
+      request->send ( 400, "", reply ) ;
+      return ;
+    }
+    upabort ( "" ) ;                                  // Close the file, free buffer
+    t = millis() - t + 1 ;                            // Duration, prevent division by zero
+    if ( request->hasParam ( "crc" ) )                // Check requested?
+    {
+      crc = strtoul ( request->getParam ( "crc" )->value().c_str(), NULL, 16 ) ;
+      good = ( crc == upcrc ) ;
+    }
+    reply = dbgprint ( "File upload %s, CRC %08X %s, %d bytes, %d kB/s, "
+                       "%d underruns, %d forced writes",
+                       filename.c_str(), upcrc, good ? "OK" : "BAD",
+                       upin, ( upin - offset ) / t,
+                       underruns - underruns0, upforced ) ;
+    request->send ( good ? 200 : 400, "", reply ) ;
   }
 }
 
@@ -2916,6 +3203,9 @@ String chomp ( String str )
 //   mqtttopic  = mytopic                   // Set MQTT topic to subscribe to *)           *
 //   mqttpubtopic = mypubtopic              // Set MQTT topic to publish to *)             *
 //   status                                 // Show current URL to play                    *
+//   rate       = <ppm2>                    // Adjust playback rate, stops automatic mode  *
+//   ratectl    = 0 or 1                    // Automatic clock drift compensation off/on   *
+//   ratestat                               // Show clock drift compensation status        *
 //   testfile   = <file on SPIFFS>          // Test SPIFFS reads for debugging purpose     *
 //   test                                   // For test purposes                           *
 //   debug      = 0 or 1                    // Switch debugging on or off                  *
@@ -3107,7 +3397,27 @@ char* analyzeCmd ( const char* par, const char* val )
   }
   else if ( argument == "rate" )                      // Rate command?
   {
-    vs1053player.AdjustRate ( ivalue ) ;              // Yes, adjust
+    ratectl = false ;                                 // Yes, no automatic control anymore
+    rateppm2 = value.toInt() ;                        // Value may be negative
+    vs1053player.AdjustRate ( rateppm2 ) ;            // Adjust
+    sprintf ( reply, "Rate correction is now %d ppm2", rateppm2 ) ;
+  }
+  else if ( argument.startsWith ( "rate" ) )          // Rate control?
+  {
+    if ( argument == "ratectl" )                      // Switch on/off?
+    {
+      ratectl = ( ivalue != 0 ) ;                     // Yes, set flag accordingly
+      ratewait = RATEWAIT ;                           // Filter and integral are stale
+      if ( !ratectl )                                 // Switched off?
+      {
+        rateppm2 = 0 ;                                // Yes, remove correction
+        vs1053player.AdjustRate ( 0 ) ;
+      }
+    }
+    sprintf ( reply, "Rate control %s, correction %d ppm2, "
+              "buffer %d/1000, filtered %d/1000, target %d/1000",
+              ratectl ? "on" : "off", rateppm2,
+              ringlevel ( ringavail() ), ratelvl / 16, RATETARGET ) ;
   }
   else if ( argument.startsWith ( "mqtt" ) )          // Parameter fo MQTT?
   {
@@ -0,0 +1,54 @@
+//******************************************************************************************
+// Clock drift compensation.                                                               *
+//******************************************************************************************
+// The clock of the VS1053 is never exactly the same as the clock of the station.  Over    *
+// time, the ringbuffer will run dry or overflow.  A PI controller on the filling of the   *
+// ringbuffer trims the playback rate (see VS1053::AdjustRate).                            *
+//******************************************************************************************
+
+#include "drift.hpp"
+
+// Global variables
+int32_t rateppm2 = 0 ;                        // Current rate correction in ppm2
+int32_t ratelvl ;                             // Filtered filling in 1/16 per mille
+int32_t rateint ;                             // Sum of errors for integral part
+
+
+//******************************************************************************************
+//                                R A T E S T A R T                                        *
+//******************************************************************************************
+// Start the controller with the current filling of the ringbuffer (per mille).  It will   *
+// continue with the current correction.                                                   *
+//******************************************************************************************
+void ratestart ( uint16_t level )
+{
+  ratelvl = (int32_t)level * 16 ;             // Start filter here
+  rateint = rateppm2 * RATEKI ;               // and continue with current correction
+}
+
+
+//******************************************************************************************
+//                                R A T E S T E P                                          *
+//******************************************************************************************
+// One step of the clock drift controller.  The input is the lowest filling of the         *
+// ringbuffer (per mille) in the last interval.  Using the lowest value ignores the bursts *
+// of the network.  The result is the new rate correction in ppm2, positive if the         *
+// ringbuffer is too full and playback must be faster.                                     *
+//******************************************************************************************
+int32_t ratestep ( uint16_t level )
+{
+  int32_t err ;                               // Error in 1/16 per mille
+  int32_t newppm2 ;                           // New correction
+
+  ratelvl += ( (int32_t)level * 16 - ratelvl ) / 8 ;  // Low pass filter
+  err = ratelvl - RATETARGET * 16 ;           // Deviation from target
+  newppm2 = ( rateint + err ) / RATEKI + err / RATEKP ;
+  if ( ( newppm2 > -RATEMAX ) && ( newppm2 < RATEMAX ) )
+  {
+    rateint += err ;                          // Integrate only if not at the limit
+  }
+  newppm2 = rateint / RATEKI + err / RATEKP ; // Integral plus proportional part
+  newppm2 = constrain ( newppm2, rateppm2 - RATESTEP, // Limit the change
+                        rateppm2 + RATESTEP ) ;
+  return constrain ( newppm2, -RATEMAX, RATEMAX ) ;   // Limit the correction
+}
@@ -0,0 +1,25 @@
+//******************************************************************************************
+// Header file for clock drift compensation.                                               *
+//******************************************************************************************
+
+#ifndef _DRIFT_HPP
+  #include <Arduino.h>
+
+  // Every RATEINT msec the lowest filling of the ringbuffer is used to trim the playback
+  // rate of the VS1053.  The unit of the correction is ppm2 (2 ppm2 = 1 ppm).
+  #define RATEINT  10000                      // Control interval in msec
+  #define RATEWAIT     6                      // Intervals to skip after start of stream
+  #define RATETARGET 750                      // Target filling of ringbuffer in per mille
+  #define RATESTEP     4                      // Max. change of correction per interval
+  #define RATEMAX    400                      // Max. correction (200 ppm)
+  #define RATEKP       8                      // Proportional part is error / RATEKP
+  #define RATEKI   16384                      // Integral part is sum of errors / RATEKI
+
+  extern int32_t rateppm2 ;                   // Current rate correction in ppm2
+  extern int32_t ratelvl ;                    // Filtered filling in 1/16 per mille
+  extern int32_t rateint ;                    // Sum of errors for integral part
+
+  void    ratestart ( uint16_t level ) ;
+  int32_t ratestep ( uint16_t level ) ;
+  #define _DRIFT_HPP
+#endif
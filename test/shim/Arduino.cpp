@@ -0,0 +1,7 @@
+//******************************************************************************************
+// Minimal Arduino shim for host tests of the Esp-radio modules.                           *
+//******************************************************************************************
+
+#include <Arduino.h>
+
+uint64_t shim_usec = 0 ;                      // Simulated time in usec
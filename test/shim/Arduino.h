@@ -0,0 +1,31 @@
+//******************************************************************************************
+// Minimal Arduino shim for host tests of the Esp-radio modules.                           *
+//******************************************************************************************
+// Only what the modules use: fixed width types, String, constrain, millis and micros.     *
+// The clock is simulated, tests advance it with shim_advance().                           *
+//******************************************************************************************
+
+#ifndef _ARDUINO_SHIM_H
+  #include <stdint.h>
+  #include <stdlib.h>
+  #include <string.h>
+  #include <string>
+
+  class String : public std::string
+  {
+    public:
+      String ( const char* s = "" ) : std::string ( s ) {}
+      String ( const std::string& s ) : std::string ( s ) {}
+      String ( long n ) : std::string ( std::to_string ( n ) ) {}
+      long toInt() const { return strtol ( c_str(), NULL, 10 ) ; }
+  } ;
+
+  #define constrain(x,lo,hi) ( (x) < (lo) ? (lo) : ( (x) > (hi) ? (hi) : (x) ) )
+
+  extern uint64_t shim_usec ;                 // Simulated time in usec
+
+  inline uint32_t micros() { return (uint32_t)shim_usec ; }
+  inline uint32_t millis() { return (uint32_t)( shim_usec / 1000 ) ; }
+  inline void     shim_advance ( uint64_t usec ) { shim_usec += usec ; }
+  #define _ARDUINO_SHIM_H
+#endif
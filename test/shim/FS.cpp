@@ -0,0 +1,74 @@
+//******************************************************************************************
+// In-memory file system shim for host tests of the Esp-radio modules.                     *
+//******************************************************************************************
+
+#include <LittleFS.h>
+
+std::map<std::string, std::vector<uint8_t> > shim_files ;
+std::vector<shim_write>                      shim_writes ;
+uint32_t                                     shim_free = 0xFFFFFFFF ;
+uint32_t                                     shim_reads = 0 ;
+FS                                           LittleFS ;
+
+
+size_t File::write ( const uint8_t* buf, size_t size )
+{
+  std::vector<uint8_t>& f = shim_files[path] ;
+
+  if ( !isopen )
+  {
+    return 0 ;
+  }
+  if ( size > shim_free )                     // File system full?
+  {
+    size = shim_free ;                        // Yes, short write
+  }
+  shim_free -= size ;
+  shim_writes.push_back ( { pos, (uint32_t)size } ) ;
+  f.insert ( f.end(), buf, buf + size ) ;     // Only append is used
+  pos += size ;
+  return size ;
+}
+
+
+size_t File::read ( uint8_t* buf, size_t size )
+{
+  std::vector<uint8_t>& f = shim_files[path] ;
+
+  if ( !isopen || ( pos >= f.size() ) )
+  {
+    return 0 ;
+  }
+  if ( size > ( f.size() - pos ) )
+  {
+    size = f.size() - pos ;
+  }
+  memcpy ( buf, f.data() + pos, size ) ;
+  pos += size ;
+  shim_reads++ ;
+  return size ;
+}
+
+
+File FS::open ( const String& path, const char* mode )
+{
+  if ( *mode == 'r' )                         // Read only existing files
+  {
+    if ( !exists ( path ) )
+    {
+      return File() ;
+    }
+    return File ( path, 0 ) ;
+  }
+  if ( *mode == 'w' )
+  {
+    shim_files[path].clear() ;                // Truncate
+  }
+  return File ( path, shim_files[path].size() ) ;
+}
+
+
+bool FS::remove ( const String& path )
+{
+  return shim_files.erase ( path ) != 0 ;
+}
@@ -0,0 +1,44 @@
+//******************************************************************************************
+// In-memory file system shim for host tests of the Esp-radio modules.                     *
+//******************************************************************************************
+// Files live in a map.  The free space can be limited to test short writes.  Every write  *
+// is logged (file position and length) so tests can check the page alignment.             *
+//******************************************************************************************
+
+#ifndef _FS_SHIM_H
+  #include <Arduino.h>
+  #include <map>
+  #include <vector>
+
+  struct shim_write { uint32_t pos ; uint32_t len ; } ;
+
+  extern std::map<std::string, std::vector<uint8_t> > shim_files ;
+  extern std::vector<shim_write>                      shim_writes ;
+  extern uint32_t                                     shim_free ;     // Bytes left on FS
+  extern uint32_t                                     shim_reads ;    // Number of reads
+
+  class File
+  {
+    public:
+      File() : isopen ( false ), pos ( 0 ) {}
+      File ( const std::string& p, uint32_t start ) : isopen ( true ), path ( p ), pos ( start ) {}
+      size_t   write ( const uint8_t* buf, size_t size ) ;
+      size_t   read ( uint8_t* buf, size_t size ) ;
+      size_t   size() const { return isopen ? shim_files[path].size() : 0 ; }
+      void     close() { isopen = false ; }
+      operator bool() const { return isopen ; }
+    private:
+      bool        isopen ;
+      std::string path ;
+      uint32_t    pos ;
+  } ;
+
+  class FS
+  {
+    public:
+      File open ( const String& path, const char* mode ) ;
+      bool remove ( const String& path ) ;
+      bool exists ( const String& path ) { return shim_files.count ( path ) != 0 ; }
+  } ;
+  #define _FS_SHIM_H
+#endif
@@ -0,0 +1,10 @@
+//******************************************************************************************
+// LittleFS shim for host tests, see FS.h.                                                 *
+//******************************************************************************************
+
+#ifndef _LITTLEFS_SHIM_H
+  #include <FS.h>
+
+  extern FS LittleFS ;
+  #define _LITTLEFS_SHIM_H
+#endif
@@ -0,0 +1,25 @@
+//******************************************************************************************
+// Check helpers for the host tests of the Esp-radio modules.                              *
+//******************************************************************************************
+
+#include <stdio.h>
+#include "check.h"
+
+int failures = 0 ;                            // Number of failed checks
+
+
+void check ( bool ok, const char* what, long got )
+{
+  printf ( "%-50s %8ld  %s\n", what, got, ok ? "ok" : "FAIL" ) ;
+  if ( !ok )
+  {
+    failures++ ;
+  }
+}
+
+
+int checkresult()
+{
+  printf ( "%d failures\n", failures ) ;
+  return failures != 0 ;
+}
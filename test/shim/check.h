@@ -0,0 +1,14 @@
+//******************************************************************************************
+// Check helpers for the host tests of the Esp-radio modules.                              *
+//******************************************************************************************
+// Every check prints one line with a description, a value for diagnosis and "ok" or       *
+// "FAIL".  checkresult() prints the number of failed checks and gives the exit code.       *
+//******************************************************************************************
+
+#ifndef _CHECK_H
+  extern int failures ;                       // Number of failed checks
+
+  void check ( bool ok, const char* what, long got ) ;
+  int  checkresult() ;
+  #define _CHECK_H
+#endif
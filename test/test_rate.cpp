@@ -0,0 +1,182 @@
+//******************************************************************************************
+// Host simulation for drift.cpp.                                                          *
+//******************************************************************************************
+// A 128 kbit/s stream is played for 3 days with a clock offset between the station and    *
+// the VS1053.  The network delivers in bursts (up to 4 times the bitrate) and has random  *
+// stalls.  The controller is called like handle_rate() in Esp_radio.ino.  Checks that the *
+// correction settles at the clock offset and that the ringbuffer stays near the target.   *
+// Note that stalls longer than the ringbuffer (about 1 second) cause underruns and every  *
+// underrun adds latency that can only be removed slowly (max. 200 ppm).                   *
+//******************************************************************************************
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include "check.h"
+#include "drift.hpp"
+
+#define RINGBFSIZ 18000                       // As in Esp_radio.ino
+#define DT        0.05                        // Simulation step in seconds
+#define DAYS      3
+
+uint32_t rnd = 12345 ;                        // For random stalls
+
+
+double uniform()
+{
+  rnd = rnd * 1103515245 + 12345 ;
+  return ( ( rnd >> 8 ) + 0.5 ) / 16777216.0 ;
+}
+
+
+struct simresult
+{
+  uint32_t underruns ;                        // Underruns in total
+  uint32_t lateunderruns ;                    // Underruns after the first day
+  int      lo, hi ;                           // Range of filling after the first day
+  double   avgppm2 ;                          // Average correction over the last day
+} ;
+
+
+// Simulate DAYS days.  offset is the station clock minus the VS1053 clock in ppm.
+// stallper is the average time between network stalls in seconds (0 is no stalls),
+// stalllen the average length of a stall.
+simresult simulate ( double offset, double stallper, double stalllen, bool ctl )
+{
+  double    rate = 128000 / 8 ;               // Bytes per second
+  double    ring = RINGBFSIZ / 2 ;            // Filling of ringbuffer
+  double    queue = 0 ;                       // Data waiting in network
+  double    stall = 0 ;                       // Remaining time of network stall
+  double    minring = RINGBFSIZ ;             // Lowest filling in interval
+  double    d ;                               // Amount of data
+  double    sum = 0 ;                         // For average correction
+  uint32_t  nsum = 0 ;
+  uint32_t  underruns0 = 0 ;                  // Underruns at start of interval
+  uint8_t   wait = RATEWAIT ;                 // Intervals to skip
+  bool      dry = false ;                     // Ringbuffer is empty
+  long      steps = (long)( DAYS * 86400 / DT ) ;
+  long      perint = (long)( RATEINT / 1000 / DT ) ;
+  long      i ;
+  uint16_t  level ;
+  simresult r = { 0, 0, 1000, 0, 0 } ;
+
+  rateppm2 = 0 ;
+  for ( i = 1 ; i <= steps ; i++ )
+  {
+    queue += rate * ( 1 + offset * 1e-6 ) * DT ;  // Station sends
+    if ( stall > 0 )
+    {
+      stall -= DT ;                           // Network stalls
+    }
+    else
+    {
+      if ( stallper && ( uniform() < DT / stallper ) )
+      {
+        stall = -log ( uniform() ) * stalllen ;   // Start of new stall
+      }
+      d = std::min ( std::min ( queue, RINGBFSIZ - ring ), 4 * rate * DT ) ;
+      ring += d ;                             // Network delivers
+      queue -= d ;
+    }
+    d = rate * ( 1 + rateppm2 * 0.5e-6 ) * DT ; // VS1053 plays
+    if ( ring < d )
+    {
+      if ( !dry )
+      {
+        r.underruns++ ;                       // Ran dry
+        if ( i * DT > 86400 )
+        {
+          r.lateunderruns++ ;
+        }
+      }
+      dry = true ;
+      d = ring ;
+    }
+    else
+    {
+      dry = false ;
+    }
+    ring -= d ;
+    minring = std::min ( minring, ring ) ;
+    if ( ( i % perint ) == 0 )                // End of interval, like handle_rate()
+    {
+      level = (uint16_t)( minring * 1000 / RINGBFSIZ ) ;
+      if ( wait )
+      {
+        if ( --wait == 0 )
+        {
+          ratestart ( level ) ;
+        }
+      }
+      else if ( ctl && ( r.underruns == underruns0 ) )
+      {
+        rateppm2 = ratestep ( level ) ;
+      }
+      underruns0 = r.underruns ;
+      minring = RINGBFSIZ ;
+      if ( i * DT > 86400 )                   // Settled?
+      {
+        r.lo = std::min ( r.lo, (int)level ) ;
+        r.hi = std::max ( r.hi, (int)level ) ;
+      }
+      if ( i * DT > ( DAYS - 1 ) * 86400 )    // Last day?
+      {
+        sum += rateppm2 ;
+        nsum++ ;
+      }
+    }
+  }
+  r.avgppm2 = sum / nsum ;
+  return r ;
+}
+
+
+int main()
+{
+  static const double offsets[] = { -150, -50, -10, 0, 10, 50, 150 } ;
+  char      what[80] ;
+  simresult r ;
+  int32_t   p ;
+  size_t    i ;
+
+  // Start with a manual correction: continues without a jump
+  rateppm2 = 100 ;
+  ratestart ( RATETARGET ) ;
+  p = ratestep ( RATETARGET ) ;
+  check ( p == 100, "start with correction, no jump", p ) ;
+  // Change per step and total correction are limited
+  rateppm2 = 0 ;
+  ratestart ( 1000 ) ;
+  p = ratestep ( 1000 ) ;
+  check ( p == RATESTEP, "full buffer, limited step", p ) ;
+  rateppm2 = RATEMAX ;
+  p = ratestep ( 1000 ) ;
+  check ( p == RATEMAX, "full buffer, limited correction", p ) ;
+  // Without control the ringbuffer runs dry if the VS1053 is faster
+  r = simulate ( -50, 0, 0, false ) ;
+  check ( r.underruns > 0, "no control, -50 ppm, underruns", r.underruns ) ;
+  printf ( "    offset   stalls   correction   filling   underruns\n" ) ;
+  printf ( "    (ppm)    (/h)     (ppm2)       (/1000)   (total/late)\n" ) ;
+  for ( i = 0 ; i < sizeof(offsets) / sizeof(offsets[0]) ; i++ )
+  {
+    // Stable network
+    r = simulate ( offsets[i], 0, 0, true ) ;
+    printf ( "    %6.0f   %6d   %10.1f   %3d-%3d   %u/%u\n", offsets[i], 0, r.avgppm2,
+             r.lo, r.hi, r.underruns, r.lateunderruns ) ;
+    sprintf ( what, "%+.0f ppm, correction", offsets[i] ) ;
+    check ( fabs ( r.avgppm2 - 2 * offsets[i] ) < 4, what, (int32_t)r.avgppm2 ) ;
+    sprintf ( what, "%+.0f ppm, filling near target", offsets[i] ) ;
+    check ( ( r.lo > RATETARGET - 50 ) && ( r.hi < RATETARGET + 50 ), what, r.lo ) ;
+    sprintf ( what, "%+.0f ppm, no underruns", offsets[i] ) ;
+    check ( r.underruns == 0, what, r.underruns ) ;
+    // Network with a stall of 0.1 second on average every 5 minutes
+    r = simulate ( offsets[i], 300, 0.1, true ) ;
+    printf ( "    %6.0f   %6d   %10.1f   %3d-%3d   %u/%u\n", offsets[i], 12, r.avgppm2,
+             r.lo, r.hi, r.underruns, r.lateunderruns ) ;
+    sprintf ( what, "%+.0f ppm, jitter, correction", offsets[i] ) ;
+    check ( fabs ( r.avgppm2 - 2 * offsets[i] ) < 10, what, (int32_t)r.avgppm2 ) ;
+    sprintf ( what, "%+.0f ppm, jitter, late underruns", offsets[i] ) ;
+    check ( r.lateunderruns <= 2, what, r.lateunderruns ) ;
+  }
+  return checkresult() ;
+}
@@ -0,0 +1,172 @@
+//******************************************************************************************
+// Host test for tftlayout.cpp.                                                            *
+//******************************************************************************************
+// The TFT is replaced by a framebuffer mock of 160 x 128 pixels.  Every drawn character   *
+// writes a 6 x 8 cell, the number of pixels written per update is counted.                *
+//******************************************************************************************
+
+#include <stdio.h>
+#include "check.h"
+#include "tftlayout.hpp"
+
+#define TFTROWS   15
+#define TFTSECS   3
+#define BLACK     0x0000
+#define WHITE     0xFFFF
+#define YELLOW    0x07FF
+
+uint16_t      fb[128][160] ;                  // Framebuffer mock
+char          fbchar[16][TFTCOLS] ;           // Character in every cell
+uint32_t      pixels ;                        // Pixels written since last reset
+int           budget ;                        // Characters before stop() says stop
+
+scrseg_struct tftdata[TFTSECS] =              // Same layout as in Esp_radio.ino
+{
+  { 0,  2, 0 },                               // Top 2 rows, title
+  { 20, 5, 2 },                               // 5 rows, station name/artist
+  { 60, 8, 7 }                                // 8 rows, streamtitle
+} ;
+char          tftshown[TFTROWS][TFTCOLS] ;
+
+
+bool stop()
+{
+  if ( budget < 0 )                           // Unlimited?
+  {
+    return false ;
+  }
+  return budget-- == 0 ;
+}
+
+
+void draw ( int16_t x, int16_t y, char c, uint16_t color )
+{
+  int i, j ;
+
+  for ( i = 0 ; i < 8 ; i++ )                 // Cell with background, like drawChar()
+  {
+    for ( j = 0 ; j < 6 ; j++ )
+    {
+      fb[y + i][x + j] = ( c == ' ' ) ? BLACK : color ;
+      pixels++ ;
+    }
+  }
+  fbchar[y / 8][x / 6] = c ;
+}
+
+
+// Render all segments like handle_tft(), return number of pixels written.
+uint32_t render ( int limit = -1 )
+{
+  int n ;
+
+  pixels = 0 ;
+  budget = limit ;
+  for ( n = 0 ; n < TFTSECS ; n++ )
+  {
+    if ( !tftrender ( &tftdata[n], tftshown[tftdata[n].row0], stop, draw ) )
+    {
+      break ;
+    }
+  }
+  return pixels ;
+}
+
+
+void settext ( uint8_t inx, const char* str, uint16_t color = WHITE )
+{
+  tftsettext ( &tftdata[inx], tftshown[tftdata[inx].row0], str, color ) ;
+}
+
+
+// Compare requested layout of a segment with the characters in the framebuffer.
+bool screenok ( uint8_t inx )
+{
+  scrseg_struct* seg = &tftdata[inx] ;
+  char           line[TFTCOLS] ;
+  int            row ;
+
+  for ( row = 0 ; row < seg->rows ; row++ )
+  {
+    tftlayout ( seg, row, line ) ;
+    if ( memcmp ( line, fbchar[seg->y / 8 + row], TFTCOLS ) )
+    {
+      return false ;
+    }
+  }
+  return true ;
+}
+
+
+int main()
+{
+  char     line[TFTCOLS] ;
+  char     first[TFTCOLS] ;
+  uint32_t p ;
+  int      i ;
+
+  memset ( tftshown, ' ', sizeof(tftshown) ) ;
+  memset ( fbchar, ' ', sizeof(fbchar) ) ;
+  // Initial text: only non-blank characters are drawn
+  settext ( 0, "192.168.2.8" ) ;
+  settext ( 1, "Radio 538" ) ;
+  settext ( 2, "Artist - Title" ) ;
+  p = render() ;
+  check ( p == ( 11 + 8 + 12 ) * 48, "initial text, pixels", p ) ;
+  check ( screenok ( 0 ) && screenok ( 1 ) && screenok ( 2 ), "initial text, screen", 0 ) ;
+  // Same text again: nothing to draw
+  settext ( 2, "Artist - Title" ) ;
+  p = render() ;
+  check ( p == 0, "same text, pixels", p ) ;
+  // One character changed
+  settext ( 2, "Artist - Titlf" ) ;
+  p = render() ;
+  check ( p == 48, "one character changed, pixels", p ) ;
+  // Color change redraws the visible characters only
+  settext ( 2, "Artist - Titlf", YELLOW ) ;
+  p = render() ;
+  check ( p == 12 * 48, "color change, pixels", p ) ;
+  check ( fb[60][0] == YELLOW, "color change, new color", fb[60][0] ) ;
+  // Wrapped text, 2 rows
+  settext ( 1, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcd" ) ;
+  p = render() ;
+  check ( screenok ( 1 ), "wrapped text, screen", p ) ;
+  tftlayout ( &tftdata[1], 1, line ) ;
+  check ( memcmp ( line, "abcd  ", 6 ) == 0, "wrapped text, second row", 0 ) ;
+  // Rendering in slices of 5 characters gives the same result
+  settext ( 2, "The quick brown fox\njumps over\nthe lazy dog" ) ;
+  p = 0 ;
+  for ( i = 0 ; i < 100 && tftdata[2].update_req ; i++ )
+  {
+    p += render ( 5 ) ;
+  }
+  check ( screenok ( 2 ), "sliced rendering, screen", i ) ;
+  check ( p <= ( 19 + 10 + 12 + 13 ) * 48, "sliced rendering, pixels", p ) ;
+  // Clearing a segment draws blanks over visible characters only
+  settext ( 0, "" ) ;
+  p = render() ;
+  check ( p == 11 * 48, "clear segment, pixels", p ) ;
+  // Long lines that do not fit in the segment scroll with a period of the lcm
+  settext ( 0, "A line that is too long for one row\nAnother line that is much too long" ) ;
+  check ( tftdata[0].scrolling, "long lines, scrolling", tftdata[0].scrollper ) ;
+  check ( tftdata[0].scrollper == 38 * 39, "long lines, scroll period", tftdata[0].scrollper ) ;
+  render() ;
+  tftlayout ( &tftdata[0], 0, first ) ;
+  tftscroll ( &tftdata[0] ) ;
+  p = render() ;
+  check ( p > 0 && p <= 2 * TFTCOLS * 48, "scroll step, pixels", p ) ;
+  for ( i = 1 ; i < tftdata[0].scrollper ; i++ )
+  {
+    tftscroll ( &tftdata[0] ) ;
+  }
+  check ( tftdata[0].scrollpos == 0, "scroll period, wraps", tftdata[0].scrollpos ) ;
+  tftlayout ( &tftdata[0], 0, line ) ;
+  check ( memcmp ( line, first, TFTCOLS ) == 0, "scroll period, same row", 0 ) ;
+  // Days of scrolling do not overflow the position
+  for ( i = 0 ; i < 24 * 3600 * 1000 / 300 ; i++ )
+  {
+    tftscroll ( &tftdata[0] ) ;
+  }
+  check ( tftdata[0].scrollpos < tftdata[0].scrollper, "one day of scrolling, position", tftdata[0].scrollpos ) ;
+  return checkresult() ;
+}
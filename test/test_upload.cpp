@@ -0,0 +1,224 @@
+//******************************************************************************************
+// Host test and benchmark for upload.cpp.                                                 *
+//******************************************************************************************
+// Uploads run against the in-memory LittleFS shim.  Fragments arrive like the callbacks   *
+// of the webserver, in between a number of loop() passes may write a page.  Checks       *
+// the file contents, the CRC against a table driven reference and the page alignment of   *
+// all flash writes.  The benchmark reports the staging/CRC/write speed on this host.      *
+//******************************************************************************************
+
+#include <stdio.h>
+#include <chrono>
+#include <algorithm>
+#include <LittleFS.h>
+#include "check.h"
+#include "upload.hpp"
+
+#define FRAGSIZ   1436                        // Typical TCP segment size
+
+uint8_t  src[1000000] ;                       // Data to upload
+uint32_t maxreads ;                           // Max. file reads in one upload callback
+
+
+// Reference CRC32, table driven, independent of updatecrc().
+uint32_t refcrc ( const uint8_t* data, size_t len )
+{
+  static uint32_t table[256] ;
+  uint32_t        c ;
+  uint32_t        crc = 0xFFFFFFFF ;
+  int             i, j ;
+
+  if ( table[1] == 0 )
+  {
+    for ( i = 0 ; i < 256 ; i++ )
+    {
+      c = i ;
+      for ( j = 0 ; j < 8 ; j++ )
+      {
+        c = ( c & 1 ) ? ( 0xEDB88320 ^ ( c >> 1 ) ) : ( c >> 1 ) ;
+      }
+      table[i] = c ;
+    }
+  }
+  while ( len-- )
+  {
+    crc = table[( crc ^ *data++ ) & 0xFF] ^ ( crc >> 8 ) ;
+  }
+  return ~crc ;
+}
+
+
+// No write crosses a page boundary and only the first write (resume) may start in the
+// middle of a page.
+bool aligned()
+{
+  size_t i ;
+  bool   ok = true ;
+
+  for ( i = 0 ; i < shim_writes.size() ; i++ )
+  {
+    const shim_write& w = shim_writes[i] ;
+    if ( ( w.len == 0 ) || ( ( w.pos % UPPAGE ) + w.len > UPPAGE ) )
+    {
+      ok = false ;                            // Crosses a page boundary
+    }
+    if ( ( w.pos % UPPAGE ) && ( i > 0 ) )
+    {
+      ok = false ;                            // Starts mid-page, but not the first write
+    }
+  }
+  return ok ;
+}
+
+
+// Upload src[offset..size> like handleFileUpload().  After every fragment "steps"
+// pages are written, like loop() passes.  If abandon is true, the client disappears
+// before the final fragment and the upload is saved like handle_upload() does.
+// Returns true if upload was completed.
+bool upload ( const char* path, uint32_t offset, uint32_t size, int steps,
+              uint32_t fragsiz = FRAGSIZ, bool abandon = false )
+{
+  uint32_t index ;
+  uint32_t n ;
+  uint32_t reads ;
+  int      i ;
+
+  shim_writes.clear() ;
+  maxreads = 0 ;
+  uploadstart ( path, offset ) ;
+  for ( index = 0 ; upbuf && ( offset + index < size ) ; index += n )
+  {
+    n = size - offset - index ;
+    if ( n > fragsiz )
+    {
+      n = fragsiz ;
+    }
+    reads = shim_reads ;
+    uploadstage ( offset + index, src + offset + index, n ) ;
+    maxreads = std::max ( maxreads, shim_reads - reads ) ;
+    for ( i = 0 ; upbuf && i < steps ; i++ )
+    {
+      writeuppage ( false ) ;
+    }
+  }
+  if ( upbuf && abandon )
+  {
+    uploadsave() ;                            // Timeout, save what we have
+    upabort ( "timeout" ) ;
+    return false ;
+  }
+  if ( upbuf )
+  {
+    reads = shim_reads ;
+    while ( writeuppage ( true ) ) ;          // Final fragment, write the rest
+    maxreads = std::max ( maxreads, shim_reads - reads ) ;
+  }
+  if ( upbuf == NULL )
+  {
+    return false ;
+  }
+  upabort ( "" ) ;                            // Close file, free buffer
+  return true ;
+}
+
+
+bool samefile ( const char* path, uint32_t size )
+{
+  std::vector<uint8_t>& f = shim_files[path] ;
+
+  return ( f.size() == size ) && ( memcmp ( f.data(), src, size ) == 0 ) ;
+}
+
+
+int main()
+{
+  uint32_t i ;
+  bool     ok ;
+  double   sec ;
+  std::chrono::steady_clock::time_point t0 ;
+
+  for ( i = 0 ; i < sizeof(src) ; i++ )
+  {
+    src[i] = ( i * 2654435761u ) >> 13 ;
+  }
+  check ( updatecrc ( 0, (const uint8_t*)"123456789", 9 ) == 0xCBF43926,
+          "updatecrc, check value", updatecrc ( 0, (const uint8_t*)"123456789", 9 ) ) ;
+  check ( updatecrc ( updatecrc ( 0, src, 1000 ), src + 1000, 3000 ) == refcrc ( src, 4000 ),
+          "updatecrc, in parts", 0 ) ;
+  // New file, loop() keeps up (6 pages per fragment)
+  ok = upload ( "/a.mp3", 0, 100000, 6 ) ;
+  check ( ok && samefile ( "/a.mp3", 100000 ), "new file, contents", upin ) ;
+  check ( upcrc == refcrc ( src, 100000 ), "new file, CRC", upcrc ) ;
+  check ( aligned(), "new file, page aligned writes", shim_writes.size() ) ;
+  check ( upforced == 0, "new file, forced writes", upforced ) ;
+  // New file, no loop() passes at all: staging buffer full, writes in callback
+  ok = upload ( "/a.mp3", 0, 100000, 0 ) ;
+  check ( ok && samefile ( "/a.mp3", 100000 ), "callback only, contents", upin ) ;
+  check ( upforced > 0, "callback only, forced writes", upforced ) ;
+  check ( aligned(), "callback only, page aligned writes", shim_writes.size() ) ;
+  // Odd sized fragments
+  ok = upload ( "/a.mp3", 0, 100001, 1, 97 ) ;
+  check ( ok && samefile ( "/a.mp3", 100001 ) && aligned(), "odd fragments, contents", upin ) ;
+  // Successful start leaves no error message
+  uploadstart ( "/f.mp3", 0 ) ;
+  check ( upbuf && ( *uperror == '\0' ), "start, no error message", 0 ) ;
+  upabort ( "" ) ;
+  // Resume of an abandoned upload, mid-page offset, callback only (worst case)
+  upload ( "/b.mp3", 0, 600000, 6, FRAGSIZ, true ) ;
+  check ( samefile ( "/b.mp3", 600000 ), "abandoned, staged data saved",
+          shim_files["/b.mp3"].size() ) ;
+  check ( shim_files.count ( "/b.mp3" UPCHECK ) == 1, "abandoned, checkpoint saved", 0 ) ;
+  i = shim_files["/b.mp3"].size() ;
+  ok = upload ( "/b.mp3", i, sizeof(src), 0 ) ;
+  check ( ok && samefile ( "/b.mp3", sizeof(src) ), "resume, contents", upin ) ;
+  check ( upcrc == refcrc ( src, sizeof(src) ), "resume, CRC of complete file", upcrc ) ;
+  check ( maxreads == 0, "resume, file reads in one callback", maxreads ) ;
+  check ( aligned(), "resume, page aligned writes", shim_writes.size() ) ;
+  check ( upforced <= shim_writes.size(), "resume, forced writes", upforced ) ;
+  check ( shim_files.count ( "/b.mp3" UPCHECK ) == 0, "resume, checkpoint removed", 0 ) ;
+  // Resume with loop() passes
+  upload ( "/b.mp3", 0, 50000, 6, FRAGSIZ, true ) ;
+  i = shim_files["/b.mp3"].size() ;
+  ok = upload ( "/b.mp3", i, 100000, 6 ) ;
+  check ( ok && samefile ( "/b.mp3", 100000 ), "resume with loop, contents", upin ) ;
+  check ( upcrc == refcrc ( src, 100000 ), "resume with loop, CRC", upcrc ) ;
+  check ( aligned() && ( shim_writes[0].pos % UPPAGE ), "resume with loop, page aligned", i ) ;
+  // Resume with wrong offset: refused, file and checkpoint untouched
+  upload ( "/b.mp3", 0, 50000, 6, FRAGSIZ, true ) ;
+  i = shim_files["/b.mp3"].size() ;
+  ok = upload ( "/b.mp3", i - 100, 100000, 6 ) ;
+  check ( !ok && ( shim_files["/b.mp3"].size() == i ), "wrong offset, refused", 0 ) ;
+  printf ( "    %s\n", uperror ) ;
+  ok = upload ( "/b.mp3", i, 100000, 6 ) ;
+  check ( ok && ( upcrc == refcrc ( src, 100000 ) ), "wrong offset, then right offset", upcrc ) ;
+  // Resume of a completed upload (no checkpoint): refused, file untouched
+  ok = upload ( "/b.mp3", 100000, 200000, 6 ) ;
+  check ( !ok && samefile ( "/b.mp3", 100000 ), "no checkpoint, refused", 0 ) ;
+  printf ( "    %s\n", uperror ) ;
+  // Missing fragment
+  uploadstart ( "/c.mp3", 0 ) ;
+  uploadstage ( 0, src, 1000 ) ;
+  uploadstage ( 2000, src + 2000, 1000 ) ;
+  check ( upbuf == NULL, "missing fragment, aborted", 0 ) ;
+  // Repeated fragment is skipped
+  uploadstart ( "/c.mp3", 0 ) ;
+  uploadstage ( 0, src, 1000 ) ;
+  uploadstage ( 500, src + 500, 1000 ) ;
+  while ( writeuppage ( true ) ) ;
+  upabort ( "" ) ;
+  check ( samefile ( "/c.mp3", 1500 ), "repeated fragment, contents", 0 ) ;
+  // File system full: short write
+  shim_free = 10000 ;
+  ok = upload ( "/d.mp3", 0, 100000, 2 ) ;
+  check ( !ok && ( upbuf == NULL ), "file system full, aborted", shim_files["/d.mp3"].size() ) ;
+  printf ( "    %s\n", uperror ) ;
+  shim_free = 0xFFFFFFFF ;
+  // Benchmark
+  t0 = std::chrono::steady_clock::now() ;
+  ok = upload ( "/e.mp3", 0, sizeof(src), 1 ) ;
+  sec = std::chrono::duration<double> ( std::chrono::steady_clock::now() - t0 ).count() ;
+  check ( ok && ( upcrc == refcrc ( src, sizeof(src) ) ), "benchmark, CRC", upcrc ) ;
+  printf ( "    %u bytes in %.3f sec, %.0f kB/s, %u writes\n", (unsigned)sizeof(src), sec,
+           sizeof(src) / sec / 1000, (unsigned)shim_writes.size() ) ;
+  return checkresult() ;
+}
@@ -0,0 +1,212 @@
+//******************************************************************************************
+// TFT layout routines.                                                                    *
+//******************************************************************************************
+// The screen is divided in segments of text rows.  Every segment has requested contents.  *
+// The characters that are on the screen are kept in a "shown" array, so only the changed  *
+// characters have to be drawn.  Drawing is done by a callback, so these routines do not   *
+// depend on the display driver.                                                           *
+//******************************************************************************************
+
+#include "tftlayout.hpp"
+
+
+//******************************************************************************************
+//                              T F T S E T T E X T                                        *
+//******************************************************************************************
+// Set the requested (ASCII) text of a screen segment in a specified color.  "shown"       *
+// points to the characters on the screen for the first row of the segment.                *
+//******************************************************************************************
+void tftsettext ( scrseg_struct* seg, char* shown, const char* str, uint16_t color )
+{
+  const char*    p ;                          // Points to begin of a line
+  int            len ;                        // Length of a line
+  int            nrows = 0 ;                  // Number of rows if wrapped
+  bool           longline = false ;           // Line longer than screenwidth seen
+  uint32_t       per = 1 ;                    // Scroll period of all long lines
+  uint32_t       a, b, r ;                    // For greatest common divisor
+  int            i ;                          // Loop control
+
+  if ( ( seg->str == str ) && ( seg->color == color ) )
+  {
+    return ;                                  // No change, nothing to do
+  }
+  if ( seg->color != color )                  // Color change?
+  {
+    for ( i = 0 ; i < ( seg->rows * TFTCOLS ) ; i++ )
+    {
+      if ( shown[i] != ' ' )                  // Yes, redraw visible characters
+      {
+        shown[i] = '\0' ;
+      }
+    }
+    seg->color = color ;
+  }
+  seg->str = str ;                            // Save the requested contents
+  for ( p = str ; ; p += len + 1 )            // Count rows needed for wrapped text
+  {
+    len = strcspn ( p, "\n" ) ;               // Length of this line
+    nrows += ( len + TFTCOLS - 1 ) / TFTCOLS ;  // Add number of rows for this line
+    if ( len == 0 )
+    {
+      nrows++ ;                               // Empty line also takes a row
+    }
+    if ( len > TFTCOLS )                      // Line will scroll if it does not fit?
+    {
+      longline = true ;
+      a = per ;                               // Yes, period becomes least common multiple
+      b = len + TFTGAP ;                      // of the periods of all long lines
+      while ( b )
+      {
+        r = a % b ;
+        a = b ;
+        b = r ;
+      }
+      per = per / a * ( len + TFTGAP ) ;
+      if ( per > 0xFFFF )                     // Too big?
+      {
+        per = len + TFTGAP ;                  // Yes, only this line will scroll smoothly
+      }
+    }
+    if ( p[len] == '\0' )                     // Last line?
+    {
+      break ;
+    }
+  }
+  // Scroll if the wrapped text does not fit and wrapping was the reason
+  seg->scrolling = longline && ( nrows > seg->rows ) ;
+  seg->scrollpos = 0 ;                        // Start at begin of line
+  seg->scrollper = per ;
+  seg->nextrow = 0 ;                          // Check all rows again
+  seg->update_req = true ;                    // Request update of screen
+}
+
+
+//******************************************************************************************
+//                              T F T S C R O L L                                          *
+//******************************************************************************************
+// Scroll the long lines of a segment one position.                                        *
+//******************************************************************************************
+void tftscroll ( scrseg_struct* seg )
+{
+  if ( seg->scrolling )                       // Segment with long lines?
+  {
+    if ( ++seg->scrollpos >= seg->scrollper ) // Yes, scroll one position
+    {
+      seg->scrollpos = 0 ;                    // End of period, start again
+    }
+    seg->nextrow = 0 ;                        // and check all rows
+    seg->update_req = true ;
+  }
+}
+
+
+//******************************************************************************************
+//                              T F T L A Y O U T                                          *
+//******************************************************************************************
+// Compute the requested contents of one text row of a screen segment.                     *
+// Lines (separated by "\n") are wrapped if all the text fits in the segment.  Otherwise   *
+// every line gets one row and a line that is too long will scroll horizontally.           *
+//******************************************************************************************
+void tftlayout ( scrseg_struct* seg, uint8_t row, char* line )
+{
+  const char* p = seg->str.c_str() ;          // Points to begin of a line
+  int         len ;                           // Length of this line
+  int         n ;                             // Number of rows for this line
+  int         k ;                             // Index in line
+  int         i ;                             // Loop control
+  uint8_t     r = 0 ;                         // First row of this line
+
+  memset ( line, ' ', TFTCOLS ) ;             // Default is empty row
+  while ( true )
+  {
+    len = strcspn ( p, "\n" ) ;               // Length of this line
+    if ( seg->scrolling )
+    {
+      n = 1 ;                                 // One row per line
+      if ( r == row )                         // Is this our row?
+      {
+        if ( len > TFTCOLS )                  // Yes, too long?
+        {
+          for ( i = 0 ; i < TFTCOLS ; i++ )   // Yes, show part of it
+          {
+            k = ( seg->scrollpos + i ) % ( len + TFTGAP ) ;
+            if ( k < len )
+            {
+              line[i] = p[k] ;
+            }
+          }
+        }
+        else
+        {
+          memcpy ( line, p, len ) ;           // Fits, copy the whole line
+        }
+        return ;
+      }
+    }
+    else
+    {
+      n = ( len + TFTCOLS - 1 ) / TFTCOLS ;   // Number of rows if wrapped
+      if ( n == 0 )
+      {
+        n = 1 ;                               // Empty line takes a row
+      }
+      if ( row < ( r + n ) )                  // Our row in this line?
+      {
+        k = ( row - r ) * TFTCOLS ;           // Yes, index of first character
+        len -= k ;                            // Characters left
+        if ( len > TFTCOLS )
+        {
+          len = TFTCOLS ;                     // Limit to one row
+        }
+        memcpy ( line, p + k, len ) ;         // Copy part of the line
+        return ;
+      }
+    }
+    r += n ;                                  // Next line
+    if ( ( p[len] == '\0' ) || ( r > row ) )  // End of text?
+    {
+      return ;                                // Yes, row stays empty
+    }
+    p += len + 1 ;                            // Skip line and "\n"
+  }
+}
+
+
+//******************************************************************************************
+//                              T F T R E N D E R                                          *
+//******************************************************************************************
+// Draw the characters of a segment that differ from "shown".  Before every character the  *
+// stop callback is asked if there is time left.  If not, false is returned and the next   *
+// call will continue at the same row.  True is returned if the segment is up-to-date.     *
+//******************************************************************************************
+bool tftrender ( scrseg_struct* seg, char* shown, bool (*stop)(),
+                 void (*draw)( int16_t x, int16_t y, char c, uint16_t color ) )
+{
+  char  line[TFTCOLS] ;                       // Requested contents of one row
+  char* rowshown ;                            // Current contents of this row on screen
+  int   col ;                                 // Column in row
+
+  while ( seg->update_req )                   // Something to do for this segment?
+  {
+    tftlayout ( seg, seg->nextrow, line ) ;   // Get requested contents of this row
+    rowshown = shown + seg->nextrow * TFTCOLS ;
+    for ( col = 0 ; col < TFTCOLS ; col++ )
+    {
+      if ( rowshown[col] != line[col] )       // Is this character changed?
+      {
+        if ( stop() )                         // Time left?
+        {
+          return false ;                      // No, continue this row later
+        }
+        draw ( col * 6, seg->y + seg->nextrow * 8, line[col], seg->color ) ;
+        rowshown[col] = line[col] ;           // Remember what is on the screen
+      }
+    }
+    if ( ++seg->nextrow == seg->rows )        // Segment complete?
+    {
+      seg->nextrow = 0 ;
+      seg->update_req = false ;               // Yes, segment is up-to-date
+    }
+  }
+  return true ;
+}
@@ -0,0 +1,31 @@
+//******************************************************************************************
+// Header file for TFT layout routines.                                                    *
+//******************************************************************************************
+
+#ifndef _TFTLAYOUT_HPP
+  #include <Arduino.h>
+
+  #define TFTCOLS   26                        // Number of characters on a line
+  #define TFTGAP    4                         // Spaces between end and begin of scrolling line
+
+  struct scrseg_struct                        // For screen segments
+  {
+    uint16_t     y ;                          // Begin of segment (pixel row)
+    uint8_t      rows ;                       // Number of text rows in segment
+    uint8_t      row0 ;                       // First row in tftshown[]
+    uint16_t     color ;                      // Requested text color
+    String       str ;                        // Requested text (already ASCII)
+    bool         update_req ;                 // Segment needs (partial) redraw
+    uint8_t      nextrow ;                    // Next row to be checked/redrawn
+    bool         scrolling ;                  // Lines too long, scroll them
+    uint16_t     scrollpos ;                  // Scroll position in long lines
+    uint16_t     scrollper ;                  // Scroll period, scrollpos wraps here
+  } ;
+
+  void tftsettext ( scrseg_struct* seg, char* shown, const char* str, uint16_t color ) ;
+  void tftscroll ( scrseg_struct* seg ) ;
+  void tftlayout ( scrseg_struct* seg, uint8_t row, char* line ) ;
+  bool tftrender ( scrseg_struct* seg, char* shown, bool (*stop)(),
+                   void (*draw)( int16_t x, int16_t y, char c, uint16_t color ) ) ;
+  #define _TFTLAYOUT_HPP
+#endif
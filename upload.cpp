@@ -0,0 +1,238 @@
+//******************************************************************************************
+// Upload staging routines.                                                                *
+//******************************************************************************************
+// Uploaded data is staged in a circular buffer and written to LittleFS in pages, so that  *
+// the (slow) flash writes can be done in loop() at moments the ringbuffer is filled well  *
+// enough.  Only if the staging buffer is full, a page is written in the upload callback.  *
+//******************************************************************************************
+
+#include "upload.hpp"
+#include <LittleFS.h>
+
+// Global variables
+File        upfile ;                          // File being uploaded
+uint8_t*    upbuf = NULL ;                    // Staging buffer, NULL if no upload
+uint32_t    upin ;                            // File position of next byte to stage
+uint32_t    upout ;                           // File position of next byte to write
+uint32_t    upcrc ;                           // CRC32 of the file as written to flash
+uint32_t    upforced ;                        // Pages written in upload callback
+String      uppath ;                          // Filename of upload including "/"
+const char* uperror ;                         // Reason of upload failure
+
+
+//******************************************************************************************
+//                                U P D A T E C R C                                        *
+//******************************************************************************************
+// Update a CRC32 (the one used by zip and zlib.crc32) with a block of data.  Start with 0.*
+//******************************************************************************************
+uint32_t updatecrc ( uint32_t crc, const uint8_t* data, size_t len )
+{
+  int i ;                                     // Loop control
+
+  crc = ~crc ;
+  while ( len-- )
+  {
+    crc ^= *data++ ;                          // Add next byte
+    for ( i = 0 ; i < 8 ; i++ )               // Handle 8 bits
+    {
+      crc = ( crc >> 1 ) ^ ( 0xEDB88320 & ( - ( crc & 1 ) ) ) ;
+    }
+  }
+  return ~crc ;
+}
+
+
+//******************************************************************************************
+//                                   U P A B O R T                                         *
+//******************************************************************************************
+// Stop a running upload because of an error.  The reason will be in the reply.            *
+//******************************************************************************************
+void upabort ( const char* reason )
+{
+  uperror = reason ;                          // For reply
+  if ( upbuf )                                // Upload running?
+  {
+    upfile.close() ;                          // Yes, close the file
+    free ( upbuf ) ;                          // and release the buffer
+    upbuf = NULL ;
+  }
+}
+
+
+//******************************************************************************************
+//                               W R I T E U P P A G E                                     *
+//******************************************************************************************
+// Write the next flash page from the upload staging buffer to LittleFS.  A partial page   *
+// is only written at the end of the upload (last is true).  The CRC is updated with the   *
+// data that is actually written.                                                          *
+// Returns false if there was nothing to write or if the write failed.                     *
+//******************************************************************************************
+bool writeuppage ( bool last )
+{
+  uint32_t n ;                                // Number of bytes to write
+  uint8_t* p ;                                // Begin of page in upbuf
+
+  n = UPPAGE - ( upout % UPPAGE ) ;           // Bytes up to next page boundary
+  if ( ( upin - upout ) < n )                 // Enough data staged?
+  {
+    if ( ( !last ) || ( upin == upout ) )     // No, end of upload?
+    {
+      return false ;                          // No, wait for more data
+    }
+    n = upin - upout ;                        // Yes, write the rest
+  }
+  // The page never wraps in upbuf, because UPBUFSIZ is a multiple of UPPAGE
+  p = upbuf + ( upout % UPBUFSIZ ) ;
+  if ( upfile.write ( p, n ) != n )           // Write the page
+  {
+    upabort ( "write error" ) ;               // Short write, file system full?
+    return false ;
+  }
+  upcrc = updatecrc ( upcrc, p, n ) ;         // Add to CRC
+  upout += n ;                                // Update written part
+  return true ;
+}
+
+
+//******************************************************************************************
+//                                 U P L O A D S A V E                                     *
+//******************************************************************************************
+// Save an upload that is abandoned: write the staged data and save the length and CRC of  *
+// the file in a checkpoint file, so the upload can be resumed without reading the file.   *
+// The upload must be stopped by upabort() afterwards.                                     *
+//******************************************************************************************
+void uploadsave()
+{
+  File f ;                                    // Checkpoint file
+  char buf[24] ;                              // Contents of checkpoint
+
+  while ( writeuppage ( true ) ) ;            // Write what is staged
+  if ( upbuf == NULL )                        // Write error?
+  {
+    return ;                                  // Yes, nothing to save
+  }
+  sprintf ( buf, "%lu %08lX\n", (unsigned long)upout, (unsigned long)upcrc ) ;
+  f = LittleFS.open ( uppath + UPCHECK, "w" ) ;
+  if ( f )
+  {
+    f.write ( (uint8_t*)buf, strlen ( buf ) ) ;
+    f.close() ;
+  }
+}
+
+
+//******************************************************************************************
+//                                U P L O A D S T A R T                                    *
+//******************************************************************************************
+// Start a new upload.  If offset is not 0, an abandoned upload is resumed: the data will  *
+// be appended to the file.  The offset must match the length in the checkpoint file and  *
+// the length of the file.  The CRC of the existing part is taken from the checkpoint.     *
+// On failure upbuf stays NULL and uperror has the reason.                                 *
+//******************************************************************************************
+void uploadstart ( const String& path, uint32_t offset )
+{
+  File     f ;                                // Checkpoint file
+  char     buf[24] ;                          // Contents of checkpoint
+  char*    p ;                                // End of length in checkpoint
+  uint32_t n = 0 ;                            // Length of checkpoint
+
+  upabort ( "" ) ;                            // Give up on unfinished upload
+  uppath = path ;
+  upcrc = 0 ;                                 // Start new CRC
+  upin = offset ;                             // Nothing staged yet
+  upout = offset ;                            // Nothing written yet
+  upforced = 0 ;
+  upbuf = (uint8_t*) malloc ( UPBUFSIZ ) ;    // Get a staging buffer
+  if ( upbuf == NULL )
+  {
+    uperror = "out of memory" ;
+    return ;
+  }
+  if ( offset )                               // Resume?
+  {
+    f = LittleFS.open ( uppath + UPCHECK, "r" ) ; // Yes, get length and CRC of checkpoint
+    if ( f )
+    {
+      n = f.read ( (uint8_t*)buf, sizeof(buf) - 1 ) ;
+      f.close() ;
+    }
+    buf[n] = '\0' ;
+    if ( strtoul ( buf, &p, 10 ) != offset )  // Offset must match the checkpoint
+    {
+      upabort ( "no saved upload at this offset" ) ;
+      return ;
+    }
+    upcrc = strtoul ( p, NULL, 16 ) ;         // Continue with saved CRC
+    upfile = LittleFS.open ( uppath, "a" ) ;  // Open for append
+    if ( upfile && ( upfile.size() != offset ) ) // Length must match as well
+    {
+      upabort ( "offset does not match file length" ) ;
+      return ;
+    }
+    LittleFS.remove ( uppath + UPCHECK ) ;    // Checkpoint is used now
+  }
+  else
+  {
+    LittleFS.remove ( uppath + UPCHECK ) ;    // Remove old checkpoint
+    LittleFS.remove ( uppath ) ;              // Remove old file
+    upfile = LittleFS.open ( uppath, "w" ) ;  // Create new file
+  }
+  if ( !upfile )                              // Could not open the file?
+  {
+    upabort ( "cannot open file" ) ;
+  }
+}
+
+
+//******************************************************************************************
+//                                U P L O A D S T A G E                                    *
+//******************************************************************************************
+// Stage a fragment of an upload.  pos is the file position of the first byte.  Data that  *
+// was seen before is skipped, a gap aborts the upload.  If the staging buffer is full, a  *
+// page is written here (counted in upforced).                                             *
+//******************************************************************************************
+void uploadstage ( uint32_t pos, const uint8_t* data, size_t len )
+{
+  uint32_t n ;                                // Number of bytes to stage
+
+  if ( pos < upin )                           // (Partly) seen before?
+  {
+    n = upin - pos ;                          // Yes, skip the known part
+    if ( n > len )
+    {
+      n = len ;
+    }
+    data += n ;
+    len -= n ;
+  }
+  else if ( pos > upin )                      // Missing data?
+  {
+    upabort ( "fragment missing" ) ;          // Yes, give up
+    len = 0 ;
+  }
+  while ( len )
+  {
+    while ( upbuf && ( ( upin - upout ) == UPBUFSIZ ) ) // Staging buffer full?
+    {
+      writeuppage ( false ) ;                 // Yes, make room now
+      upforced++ ;                            // Count for report
+    }
+    if ( upbuf == NULL )                      // Error during write?
+    {
+      break ;                                 // Yes, forget the rest
+    }
+    n = UPBUFSIZ - ( upin % UPBUFSIZ ) ;      // Space up to end of buffer
+    if ( n > ( UPBUFSIZ - ( upin - upout ) ) )  // Limit to free space
+    {
+      n = UPBUFSIZ - ( upin - upout ) ;
+    }
+    if ( n > len )                            // Limit to fragment length
+    {
+      n = len ;
+    }
+    memcpy ( upbuf + ( upin % UPBUFSIZ ), data, n ) ;
+    upin += n ;                               // Update staged part
+    data += n ;
+    len -= n ;
+  }
+}
@@ -0,0 +1,29 @@
+//******************************************************************************************
+// Header file for upload staging routines.                                                *
+//******************************************************************************************
+
+#ifndef _UPLOAD_HPP
+  #include <Arduino.h>
+  #include <FS.h>
+
+  #define UPBUFSIZ  4096                      // Staging buffer, must be a multiple of UPPAGE
+  #define UPPAGE     256                      // Flash page size
+  #define UPCHECK  ".upl"                     // Suffix of checkpoint of abandoned upload
+
+  extern File        upfile ;                 // File being uploaded
+  extern uint8_t*    upbuf ;                  // Staging buffer, NULL if no upload
+  extern uint32_t    upin ;                   // File position of next byte to stage
+  extern uint32_t    upout ;                  // File position of next byte to write
+  extern uint32_t    upcrc ;                  // CRC32 of the file as written to flash
+  extern uint32_t    upforced ;               // Pages written in upload callback
+  extern String      uppath ;                 // Filename of upload including "/"
+  extern const char* uperror ;                // Reason of upload failure
+
+  uint32_t updatecrc ( uint32_t crc, const uint8_t* data, size_t len ) ;
+  void upabort ( const char* reason ) ;
+  bool writeuppage ( bool last ) ;
+  void uploadsave() ;
+  void uploadstart ( const String& path, uint32_t offset ) ;
+  void uploadstage ( uint32_t pos, const uint8_t* data, size_t len ) ;
+  #define _UPLOAD_HPP
+#endif